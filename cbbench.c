@@ -0,0 +1,296 @@
+/**
+ * @project: Feedback Arc Set
+ * @module cbbench
+ * @author Johannes Zottele 11911133
+ * @version 1.0
+ * @date 19.11.2020
+ * @section File Overview
+ * cbbench measures the circular buffer of circularBuffer.c on its own. It creates the buffer like
+ * the supervisor, forks a number of synthetic producers which write numbered arcsets via write_set()
+ * and reads them back as the only consumer via read_delete_set(). It reports throughput, enqueue
+ * latency percentiles and the time producers were blocked in FREE_SEM and MUTEX_SEM, and checks
+ * that every arcset arrived exactly once and undamaged.
+ * Must be compiled with -DCB_STATS, BUFFER_SIZE can be set with -DBUFFER_SIZE=n (see "make bench").
+ * Since it uses the same shm and semaphore names, it must not run next to a supervisor.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "circularBuffer.h"
+
+#ifndef CB_STATS
+#error "cbbench.c must be compiled with -DCB_STATS"
+#endif
+
+static const char *bench_name = "cbbench.c"; /**< global name of the program file (set for erro messages). */
+extern volatile sig_atomic_t quit;           /**< is set extern(in circularBuffer.c) and indicates if process should end. */
+
+#define TICK_USEC (100000) /**< interval in which the consumer checks if all producers are gone */
+
+/**
+ * @brief Holds the results of one producer.
+ * @details Stored in an anonymous shared mapping, so the producers can hand them to the parent.
+ */
+typedef struct
+{
+    cb_stats stats;       /**< semaphore statistics of the producer */
+    int failed;           /**< number of write_set() calls which returned -1 */
+    unsigned int written; /**< number of arcsets written, only their latencies are valid */
+} producer_result;
+
+/**
+ * @brief Returns the current time in seconds.
+ */
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Does nothing. Only installed so that SIGALRM interrupts read_delete_set().
+ */
+static void handle_tick(int signal)
+{
+}
+
+/**
+ * @brief Compares two doubles for qsort().
+ */
+static int compare_double(const void *x, const void *y)
+{
+    double dx = *(const double *)x;
+    double dy = *(const double *)y;
+    return (dx > dy) - (dx < dy);
+}
+
+/**
+ * @brief Runs one synthetic producer.
+ *
+ * @details Writes n arcsets. Every edge of set number seq holds (id, seq), so the consumer can
+ * tell which producer wrote it and whether it arrived complete. The time of each write_set()
+ * call is stored in latency and counted in result->written. Stops early on SIGINT or SIGTERM.
+ *
+ * @param id index of the producer.
+ * @param n number of arcsets to write.
+ * @param latency location for the n latencies of this producer in seconds.
+ * @param result location for the semaphore statistics of this producer.
+ */
+static void produce(unsigned int id, unsigned int n, double *latency, producer_result *result)
+{
+    arcset set;
+    memset(&set, 0, sizeof(set));
+    set.size = EDGE_COUNT;
+
+    for (unsigned int seq = 0; seq < n; seq++)
+    {
+        for (int i = 0; i < EDGE_COUNT; i++)
+        {
+            set.edges[i].a = id;
+            set.edges[i].b = seq;
+        }
+
+        double t0 = now();
+        int ret;
+        while ((ret = write_set(set)) == -1)
+        {
+            result->failed++;
+            if (quit == 1)
+                break;
+        }
+        if (ret == -1)
+            break;
+        latency[seq] = now() - t0;
+        result->written++;
+
+        if (quit == 1)
+            break;
+    }
+
+    result->stats = sem_stats;
+}
+
+/**
+ * @brief Checks if all producers have exited.
+ *
+ * @param running pointer to the number of producers which have not been waited for yet.
+ * @return 1 if no producer is left.
+ */
+static int producers_done(int *running)
+{
+    while (*running > 0 && waitpid(-1, NULL, WNOHANG) > 0)
+        (*running)--;
+    return *running == 0;
+}
+
+/**
+ * @brief Runs the benchmark.
+ *
+ * @details Parses -p (number of producers, default 1) and -n (arcsets per producer, default 100000),
+ * sets up the buffer via setup_supervisor() and forks the producers. The parent consumes all arcsets
+ * and counts how often each (producer, seq) pair was read. Arcsets with differing edges are counted
+ * as corrupt. A periodic SIGALRM interrupts the consumer, so it notices when all producers are gone
+ * but arcsets are missing instead of blocking forever.
+ *
+ * At the end one line with all results is printed. The latency percentiles only cover arcsets which
+ * were written, so producers stopped early do not skew them. The exit status is EXIT_FAILURE if
+ * arcsets were lost, duplicated or corrupt.
+ *
+ * @param argc argument count.
+ * @param argv Pointer to arguments [-p producers] [-n sets].
+ */
+int main(int argc, char *argv[])
+{
+    unsigned int producers = 1;
+    unsigned int n = 100000;
+    int c;
+    while ((c = getopt(argc, argv, "p:n:")) != -1)
+    {
+        switch (c)
+        {
+        case 'p':
+            producers = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            n = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-p producers] [-n sets]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (producers == 0 || n == 0)
+    {
+        fprintf(stderr, "Usage: %s [-p producers] [-n sets]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t total = (size_t)producers * n;
+    double *latency = mmap(NULL, total * sizeof(double), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    producer_result *results = mmap(NULL, producers * sizeof(producer_result), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    unsigned char *seen = calloc(total, 1);
+    if (latency == MAP_FAILED || results == MAP_FAILED || seen == NULL)
+    {
+        error_msg((char *)bench_name, __LINE__, "Could not allocate result buffers", 1);
+        exit(EXIT_FAILURE);
+    }
+
+    setup_supervisor(0, 1, 0, 0);
+
+    double start = now();
+    int running = 0;
+    for (unsigned int id = 0; id < producers; id++)
+    {
+        pid_t pid = fork();
+        if (pid == -1)
+        {
+            error_msg((char *)bench_name, __LINE__, "Could not fork producer", 1);
+            quit = 1;
+            break;
+        }
+        if (pid == 0)
+        {
+            produce(id, n, latency + (size_t)id * n, &results[id]);
+            _exit(EXIT_SUCCESS);
+        }
+        running++;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_tick;
+    sigaction(SIGALRM, &sa, NULL);
+    struct itimerval tick = {.it_interval = {0, TICK_USEC}, .it_value = {0, TICK_USEC}};
+    setitimer(ITIMER_REAL, &tick, NULL);
+
+    size_t received = 0;
+    size_t duplicated = 0;
+    size_t corrupt = 0;
+    arcset set;
+    while (received < total && quit != 1)
+    {
+        if (read_delete_set(&set) == -1)
+        {
+            int used;
+            sem_getvalue(used_sem, &used);
+            if (producers_done(&running) && used == 0) /* nothing left that could still arrive */
+                break;
+            continue;
+        }
+        received++;
+
+        edge e = set.edges[0];
+        int ok = set.size == EDGE_COUNT && e.a < producers && e.b < n;
+        for (int i = 1; ok && i < EDGE_COUNT; i++)
+            ok = set.edges[i].a == e.a && set.edges[i].b == e.b;
+        if (!ok)
+        {
+            corrupt++;
+            continue;
+        }
+
+        size_t k = (size_t)e.a * n + e.b;
+        if (seen[k]++ > 0)
+            duplicated++;
+    }
+    double elapsed = now() - start;
+
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_REAL, &off, NULL);
+    while (running > 0 && wait(NULL) > 0)
+        running--;
+
+    size_t lost = 0;
+    for (size_t k = 0; k < total; k++)
+        if (seen[k] == 0)
+            lost++;
+
+    cb_stats sum;
+    memset(&sum, 0, sizeof(sum));
+    int failed = 0;
+    size_t measured = 0; /* only written latencies are moved to the front, slots of unwritten arcsets stay 0 */
+    for (unsigned int id = 0; id < producers; id++)
+    {
+        memmove(latency + measured, latency + (size_t)id * n, results[id].written * sizeof(double));
+        measured += results[id].written;
+        sum.free_wait += results[id].stats.free_wait;
+        sum.mutex_wait += results[id].stats.mutex_wait;
+        sum.free_blocks += results[id].stats.free_blocks;
+        sum.mutex_blocks += results[id].stats.mutex_blocks;
+        failed += results[id].failed;
+    }
+
+    qsort(latency, measured, sizeof(double), compare_double);
+    double p50 = measured > 0 ? latency[(size_t)(measured * 0.5)] : 0;
+    double p99 = measured > 0 ? latency[(size_t)(measured * 0.99)] : 0;
+    double p999 = measured > 0 ? latency[(size_t)(measured * 0.999)] : 0;
+
+    printf("buffer=%d producers=%u sets=%zu time=%.3fs throughput=%.0f/s "
+           "enqueue_us p50=%.2f p99=%.2f p999=%.2f "
+           "blocked free_sem=%.3fs (%lu) mutex_sem=%.3fs (%lu) "
+           "lost=%zu duplicated=%zu corrupt=%zu interrupted=%d\n",
+           BUFFER_SIZE, producers, total, elapsed, received / elapsed,
+           p50 * 1e6, p99 * 1e6, p999 * 1e6,
+           sum.free_wait, sum.free_blocks, sum.mutex_wait, sum.mutex_blocks,
+           lost, duplicated, corrupt, failed);
+    fflush(stdout);
+
+    free(seen);
+    munmap(latency, total * sizeof(double));
+    munmap(results, producers * sizeof(producer_result));
+
+    clean_up("supervisor.c"); /* the benchmark owns the buffer like the supervisor, so unlink everything */
+
+    return lost == 0 && duplicated == 0 && corrupt == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -20,15 +20,36 @@
 #include <semaphore.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "circularBuffer.h"
 
 static char *cb_name = "circularBuffer.c";
 volatile sig_atomic_t quit = 0;
 
+struct graph_shm *shm;
+static size_t shm_size; /**< size of the mapped shared memory, set by setup_supervisor() or setup_generator() */
+static struct graph_snapshot *snap; /**< the supervisor's mapping of the snapshot, set by write_snapshot() */
+static size_t snap_size;            /**< size of the snapshot mapping */
+static int snap_fd = -1;            /**< the supervisor's file descriptor of the snapshot shm */
+static int worker_slot = -1;        /**< the generator's worker index, set by setup_generator() */
+sem_t *used_sem;
+sem_t *free_sem;
+sem_t *mutex_sem;
+sem_t *elite_sem;
+sem_t *graph_sem;
+
+#ifdef CB_STATS
+cb_stats sem_stats;
+#endif
+
 static bool usem_set = false; /**< true when USED_SEM is open. It says cleanup function wether USED_SEM should get closed or not */
 static bool fsem_set = false; /**< true when FREE_SEM is open. It says cleanup function wether FREE_SEM should get closed or not */
 static bool msem_set = false; /**< true when MUTEX_SEM is open. It says cleanup function wether MUTEX_SEM should get closed or not */
+static bool esem_set = false; /**< true when ELITE_SEM is open. It says cleanup function wether ELITE_SEM should get closed or not */
+static bool gsem_set = false; /**< true when GRAPH_SEM is open. It says cleanup function wether GRAPH_SEM should get closed or not */
+static bool owner_set = false; /**< true once setup_supervisor() was called. Only then the cleanup function unlinks shm, semaphores and fifo, which could belong to another job before */
 
 void error_msg(char *program, int line, char *msg, int with_errno)
 {
@@ -65,44 +86,89 @@ void setup_signal(void)
     sigaction(SIGTERM, &sa, NULL);
 }
 
-void setup_supervisor(void)
+void setup_supervisor(unsigned int workers, unsigned long seed, unsigned int elite_off, size_t node_cap)
 {
+    owner_set = true;
 
     int shmfd = shm_open(SHM_NAME, O_RDWR | O_CREAT, 0600);
     if (shmfd == -1)
         error_exit(cb_name, __LINE__, "Could not open shared memory", 1);
 
-    if (ftruncate(shmfd, sizeof(*shm)) < 0)
+    shm_size = sizeof(*shm) + ELITE_SIZE * node_cap * sizeof(int);
+    if (ftruncate(shmfd, shm_size) < 0)
         error_exit(cb_name, __LINE__, "Shared memory could not be assigned a memory size", 1);
 
-    shm = mmap(NULL, sizeof(*shm), PROT_WRITE | PROT_READ, MAP_SHARED, shmfd, 0); // Linux uses MAP_ANONYMOUS !!!
+    shm = mmap(NULL, shm_size, PROT_WRITE | PROT_READ, MAP_SHARED, shmfd, 0); // Linux uses MAP_ANONYMOUS !!!
     if (shm == MAP_FAILED)
         error_exit(cb_name, __LINE__, "Mapping of shared memory failed", 1);
 
     if (close(shmfd) == -1)
         error_msg(cb_name, __LINE__, "File descriptor cannot be closed", 1);
 
+    memset(shm, 0, sizeof(*shm));
+    shm->worker_count = workers;
+    shm->seed = seed;
+    shm->elite_off = elite_off;
+    shm->node_cap = node_cap;
+
     used_sem = sem_open(USED_SEM, O_CREAT, 0600, 0);
     usem_set = true;
     free_sem = sem_open(FREE_SEM, O_CREAT, 0600, BUFFER_SIZE);
     fsem_set = true;
     mutex_sem = sem_open(MUTEX_SEM, O_CREAT, 0600, 1);
     msem_set = true;
+    elite_sem = sem_open(ELITE_SEM, O_CREAT, 0600, 1);
+    esem_set = true;
+    graph_sem = sem_open(GRAPH_SEM, O_CREAT, 0600, 1);
+    gsem_set = true;
 
-    if (used_sem == SEM_FAILED || free_sem == SEM_FAILED || mutex_sem == SEM_FAILED)
+    if (used_sem == SEM_FAILED || free_sem == SEM_FAILED || mutex_sem == SEM_FAILED || elite_sem == SEM_FAILED || graph_sem == SEM_FAILED)
         error_exit(cb_name, __LINE__, "Could not open semaphore", 1);
 
+    struct stat st;
+    if (mkfifo(CONTROL_FIFO, 0600) == -1)
+    {
+        if (errno != EEXIST)
+            error_exit(cb_name, __LINE__, "Could not create control fifo", 1);
+        if (lstat(CONTROL_FIFO, &st) == -1 || !S_ISFIFO(st.st_mode)) /* a stale regular file would be read over and over */
+            error_exit(cb_name, __LINE__, "Control fifo path exists but is no fifo", 0);
+        if (st.st_uid != geteuid() || (st.st_mode & 077) != 0) /* otherwise other users could change the graph */
+            error_exit(cb_name, __LINE__, "Control fifo is not owned by this user or accessible to others", 0);
+    }
+
     setup_signal();
 }
 
-void setup_generator(void)
+/**
+ * @brief Decrements MUTEX_SEM, retrying if interrupted by a signal.
+ */
+static void lock_mutex(void)
+{
+    while (sem_wait(mutex_sem) == -1)
+    {
+        if (errno != EINTR)
+            error_exit(cb_name, __LINE__, "Semaphore equals -1 but it shouldn't", 1);
+    }
+}
+
+void setup_generator(unsigned int *index, unsigned int *count)
 {
 
     int shmfd = shm_open(SHM_NAME, O_RDWR, 0600);
     if (shmfd == -1)
         error_exit(cb_name, __LINE__, "Could not open shared memory", 1);
 
-    shm = mmap(NULL, sizeof(*shm), PROT_WRITE | PROT_READ, MAP_SHARED, shmfd, 0);
+    struct stat st;
+    if (fstat(shmfd, &st) == -1 || (size_t)st.st_size < sizeof(*shm))
+        error_exit(cb_name, __LINE__, "Shared memory has no valid size", 1);
+    shm_size = st.st_size;
+
+    shm = mmap(NULL, shm_size, PROT_WRITE | PROT_READ, MAP_SHARED, shmfd, 0);
+    if (shm == MAP_FAILED)
+        error_exit(cb_name, __LINE__, "Mapping of shared memory failed", 1);
+
+    if (close(shmfd) == -1)
+        error_msg(cb_name, __LINE__, "File descriptor cannot be closed", 1);
 
     used_sem = sem_open(USED_SEM, O_CREAT);
     usem_set = true;
@@ -110,6 +176,31 @@ void setup_generator(void)
     fsem_set = true;
     mutex_sem = sem_open(MUTEX_SEM, O_CREAT);
     msem_set = true;
+    elite_sem = sem_open(ELITE_SEM, O_CREAT);
+    esem_set = true;
+    graph_sem = sem_open(GRAPH_SEM, O_CREAT);
+    gsem_set = true;
+
+    if (used_sem == SEM_FAILED || free_sem == SEM_FAILED || mutex_sem == SEM_FAILED || elite_sem == SEM_FAILED || graph_sem == SEM_FAILED)
+        error_exit(cb_name, __LINE__, "Could not open semaphore", 1);
+
+    lock_mutex();
+    *count = shm->worker_count;
+    unsigned int slots = *count > 0 ? *count : MAX_WORKERS;
+    for (unsigned int i = 0; i < slots && worker_slot == -1; i++)
+    {
+        pid_t pid = shm->worker_pids[i];
+        if (pid == 0 || (kill(pid, 0) == -1 && errno == ESRCH)) /* free or its generator is gone */
+        {
+            shm->worker_pids[i] = getpid();
+            worker_slot = i;
+        }
+    }
+    sem_post(mutex_sem);
+
+    if (worker_slot == -1)
+        error_exit(cb_name, __LINE__, "More generators started than announced to the supervisor", 0);
+    *index = worker_slot;
 
     setup_signal();
 }
@@ -145,14 +236,35 @@ void clean_up(char *progn)
 
     printf("\nINFO: cleaning up shm and sem...\n\n");
 
-    if (munmap(shm, sizeof(shm)) == -1)
+    if (worker_slot != -1 && msem_set) /* release the worker index */
+    {
+        int slot = worker_slot;
+        worker_slot = -1;
+        lock_mutex();
+        if (shm->worker_pids[slot] == getpid())
+            shm->worker_pids[slot] = 0;
+        sem_post(mutex_sem);
+    }
+
+    if (shm != NULL && munmap(shm, shm_size) == -1)
         error_exit(cb_name, __LINE__, "Could not close mapping", 1);
 
+    if (snap != NULL && munmap(snap, snap_size) == -1)
+        error_msg(cb_name, __LINE__, "Could not close snapshot mapping", 1);
+
     if (usem_set || fsem_set || msem_set)
         if (sem_close(free_sem) == -1 || sem_close(used_sem) == -1 || sem_close(mutex_sem) == -1)
             error_msg(cb_name, __LINE__, "At least one semaphore could not be closed", 1);
 
-    if (strcmp(progn, "supervisor.c") == 0)
+    if (esem_set)
+        if (sem_close(elite_sem) == -1)
+            error_msg(cb_name, __LINE__, "Elite semaphore could not be closed", 1);
+
+    if (gsem_set)
+        if (sem_close(graph_sem) == -1)
+            error_msg(cb_name, __LINE__, "Graph semaphore could not be closed", 1);
+
+    if (owner_set && strcmp(progn, "supervisor.c") == 0)
     {
         if (shm_unlink(SHM_NAME) == -1)
             error_msg(cb_name, __LINE__, "Could not unlink shared memory", 1);
@@ -160,15 +272,53 @@ void clean_up(char *progn)
         if (sem_unlink(FREE_SEM) == -1 || sem_unlink(USED_SEM) == -1)
             error_msg(cb_name, __LINE__, "At least one semaphore could not be unlinked", 1);
 
-        if (sem_unlink(MUTEX_SEM) == -1)
+        if (sem_unlink(MUTEX_SEM) == -1 || sem_unlink(ELITE_SEM) == -1 || sem_unlink(GRAPH_SEM) == -1)
             error_msg(cb_name, __LINE__, "At least one semaphore could not be unlinked", 1);
+
+        if (unlink(CONTROL_FIFO) == -1)
+            error_msg(cb_name, __LINE__, "Could not unlink control fifo", 1);
+
+        if (snap_fd != -1 && shm_unlink(SNAPSHOT_NAME) == -1)
+            error_msg(cb_name, __LINE__, "Could not unlink graph snapshot", 1);
     }
 }
 
+#ifdef CB_STATS
+/**
+ * @brief sem_wait() which adds the time it was blocked to the given counters.
+ * 
+ * @param sem the semaphore to decrement.
+ * @param waited seconds blocked are added here.
+ * @param blocks incremented if the call blocked.
+ * @return 0 if done, -1 with errno set if sem_wait() failed.
+ */
+static int stat_wait(sem_t *sem, double *waited, unsigned long *blocks)
+{
+    if (sem_trywait(sem) == 0)
+        return 0;
+    if (errno != EAGAIN)
+        return -1;
+
+    struct timespec t0;
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int ret = sem_wait(sem);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    *waited += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    (*blocks)++;
+    return ret;
+}
+#endif
+
 int write_set(arcset set)
 {
 
+#ifdef CB_STATS
+    if (stat_wait(free_sem, &sem_stats.free_wait, &sem_stats.free_blocks) == -1)
+#else
     if (sem_wait(free_sem) == -1)
+#endif
     {
         if (errno != EINTR)
             error_exit(cb_name, __LINE__, "Semaphore equals -1 but it shouldn't", 1);
@@ -176,7 +326,11 @@ int write_set(arcset set)
             return -1;
     }
 
+#ifdef CB_STATS
+    if (stat_wait(mutex_sem, &sem_stats.mutex_wait, &sem_stats.mutex_blocks) == -1)
+#else
     if (sem_wait(mutex_sem) == -1)
+#endif
     {
         if (errno != EINTR)
             error_exit(cb_name, __LINE__, "Semaphore equals -1 but it shouldn't", 1);
@@ -232,4 +386,226 @@ int set_status(int state)
 unsigned int get_status()
 {
     return shm->status;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Returns the ordering of the elite pool entry at index i.
+ */
+static int *elite_perm(int i)
+{
+    return shm->elite_perms + (size_t)i * shm->node_cap;
+}
+
+int publish_elite(const int *perm, size_t nodes, int size, unsigned int epoch)
+{
+    if (shm->elite_off == 1 || nodes > shm->node_cap)
+        return 0;
+
+    if (sem_wait(elite_sem) == -1)
+    {
+        if (errno != EINTR)
+            error_exit(cb_name, __LINE__, "Semaphore equals -1 but it shouldn't (elite)", 1);
+        else
+            return -1;
+    }
+
+    int slot = shm->elite_count;
+    for (int i = 0; i < shm->elite_count; i++)
+    {
+        elite *e = &shm->elites[i];
+        if (e->size == size && e->epoch == epoch && e->nodes == nodes && memcmp(elite_perm(i), perm, nodes * sizeof(int)) == 0)
+        {
+            sem_post(elite_sem);
+            return 0;
+        }
+    }
+
+    if (shm->elite_count >= ELITE_SIZE) /* pool full -> replace worst entry if new one is better */
+    {
+        int worst = -1;
+        for (int i = 0; i < ELITE_SIZE; i++)
+        {
+            int key = shm->elites[i].epoch == epoch ? shm->elites[i].size : __INT_MAX__; /* stale entries go first */
+            if (key > worst)
+            {
+                worst = key;
+                slot = i;
+            }
+        }
+
+        if (worst <= size)
+        {
+            sem_post(elite_sem);
+            return 0;
+        }
+    }
+    else
+        shm->elite_count++;
+
+    shm->elites[slot].size = size;
+    shm->elites[slot].epoch = epoch;
+    shm->elites[slot].nodes = nodes;
+    memcpy(elite_perm(slot), perm, nodes * sizeof(int));
+
+    sem_post(elite_sem);
+
+    return 1;
+}
+
+int pull_elite(int *perm, size_t nodes, unsigned int idx)
+{
+    if (shm->elite_off == 1 || nodes > shm->node_cap)
+        return -1;
+
+    if (sem_wait(elite_sem) == -1)
+    {
+        if (errno != EINTR)
+            error_exit(cb_name, __LINE__, "Semaphore equals -1 but it shouldn't (elite)", 1);
+        else
+            return -1;
+    }
+
+    int size = -1;
+    if (shm->elite_count > 0)
+    {
+        int i = idx % shm->elite_count;
+        if (shm->elites[i].nodes == nodes)
+        {
+            memcpy(perm, elite_perm(i), nodes * sizeof(int));
+            size = shm->elites[i].size;
+        }
+    }
+
+    sem_post(elite_sem);
+
+    return size;
+}
+
+int lock_graph(void)
+{
+    if (sem_wait(graph_sem) == -1)
+    {
+        if (errno != EINTR)
+            error_exit(cb_name, __LINE__, "Semaphore equals -1 but it shouldn't (graph)", 1);
+        else
+            return -1;
+    }
+    return 0;
+}
+
+void unlock_graph(void)
+{
+    sem_post(graph_sem);
+}
+
+void write_snapshot(const edge *edges, size_t len, size_t nodes)
+{
+    if (snap_fd == -1)
+    {
+        snap_fd = shm_open(SNAPSHOT_NAME, O_RDWR | O_CREAT, 0600);
+        if (snap_fd == -1)
+            error_exit(cb_name, __LINE__, "Could not open graph snapshot", 1);
+    }
+
+    size_t needed = sizeof(*snap) + len * sizeof(edge);
+    if (needed > snap_size)
+    {
+        size_t size = sizeof(*snap) + 2 * len * sizeof(edge);
+        if (ftruncate(snap_fd, size) < 0)
+            error_exit(cb_name, __LINE__, "Graph snapshot could not be assigned a memory size", 1);
+
+        if (snap != NULL && munmap(snap, snap_size) == -1)
+            error_msg(cb_name, __LINE__, "Could not close snapshot mapping", 1);
+
+        snap = mmap(NULL, size, PROT_WRITE | PROT_READ, MAP_SHARED, snap_fd, 0);
+        if (snap == MAP_FAILED)
+        {
+            snap = NULL;
+            error_exit(cb_name, __LINE__, "Mapping of graph snapshot failed", 1);
+        }
+        snap_size = size;
+    }
+
+    snap->len = len;
+    snap->nodes = nodes;
+    memcpy(snap->edges, edges, len * sizeof(edge));
+}
+
+int read_snapshot(edge **edges, size_t *len, size_t *nodes)
+{
+    if (lock_graph() == -1)
+        return -1;
+
+    char *err = NULL; /* the graph is unlocked before exiting, other processes would block forever otherwise */
+    struct graph_snapshot *s = MAP_FAILED;
+    struct stat st;
+
+    int fd = shm_open(SNAPSHOT_NAME, O_RDONLY, 0600);
+    if (fd == -1)
+        err = "Could not open graph snapshot";
+    else if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct graph_snapshot))
+        err = "Graph snapshot has no valid size";
+    else if ((s = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+        err = "Mapping of graph snapshot failed";
+    else if ((*edges = malloc(s->len * sizeof(edge) + 1)) == NULL)
+        err = "Could not allocate graph";
+
+    int epoch = shm->epoch;
+    if (err == NULL)
+    {
+        *len = s->len;
+        *nodes = s->nodes;
+        memcpy(*edges, s->edges, s->len * sizeof(edge));
+    }
+
+    if (s != MAP_FAILED)
+        munmap(s, st.st_size);
+    if (fd != -1)
+        close(fd);
+    unlock_graph();
+
+    if (err != NULL)
+        error_exit(cb_name, __LINE__, err, 1);
+
+    return epoch;
+}
+
+int publish_update(graph_update upd)
+{
+    shm->updates[shm->epoch % UPDATE_LOG_SIZE] = upd;
+    shm->epoch++;
+    return shm->epoch;
+}
+
+int read_update(unsigned int epoch, graph_update *upd)
+{
+    if (sem_wait(graph_sem) == -1)
+    {
+        if (errno != EINTR)
+            error_exit(cb_name, __LINE__, "Semaphore equals -1 but it shouldn't (graph)", 1);
+        else
+            return -1;
+    }
+
+    int ret = 0;
+    if (epoch >= shm->epoch)
+        ret = -1;
+    else if (shm->epoch - epoch > UPDATE_LOG_SIZE)
+        ret = 1;
+    else
+        *upd = shm->updates[epoch % UPDATE_LOG_SIZE];
+
+    sem_post(graph_sem);
+
+    return ret;
+}
+
+unsigned long get_seed(void)
+{
+    return shm->seed;
+}
+
+unsigned int get_epoch(void)
+{
+    return shm->epoch;
+}
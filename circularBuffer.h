@@ -17,13 +17,24 @@
 #include <errno.h>
 #include <string.h>
 #include <semaphore.h>
+#include <sys/types.h>
 
 #define SHM_NAME "/graphresult"           /**< name for shm file */
-#define BUFFER_SIZE (50)                  /**< length of buffercircular */
+#define SNAPSHOT_NAME "/graphsnapshot"    /**< name for shm file holding the current graph */
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE (50)                  /**< length of buffercircular, can be overridden with -DBUFFER_SIZE=n */
+#endif
 #define EDGE_COUNT (8)                    /**< length of stored edges in arcset */
 #define USED_SEM "/fb_arc_set_used_sem"   /**< name of semaphore for used space of buffer */
 #define FREE_SEM "/fb_arc_set_free_sem"   /**< name of semaphore for free space of buffer */
 #define MUTEX_SEM "/fb_arc_set_mutex_sem" /**< name of semaphore for exklusive write permission for process to buffer */
+#define ELITE_SEM "/fb_arc_set_elite_sem" /**< name of semaphore for exklusive access to the elite pool */
+#define GRAPH_SEM "/fb_arc_set_graph_sem" /**< name of semaphore for exklusive access to the graph update log */
+#define CONTROL_FIFO "/tmp/fb_arc_set_ctl"  /**< path of the fifo the supervisor reads graph updates from */
+#define UPDATE_LOG_SIZE (256)             /**< number of graph updates kept in shared memory */
+#define ELITE_SIZE (4)                    /**< number of orderings kept in the elite pool */
+#define NODE_MARGIN (1024)                /**< nodes runtime inserts may add beyond the initial graph, unless set by supervisor -n */
+#define MAX_WORKERS (256)                 /**< maximum number of generators running at once */
 
 /*************************************
  *  GENERAL GLOBALLY USED FUNCTIONS  *
@@ -99,9 +110,35 @@ typedef struct
 typedef struct
 {
     int size;               /**< stores the length of the solution set. Maximum is EDGE_COUNT */
+    unsigned int epoch;     /**< graph epoch the solution set was computed for */
     edge edges[EDGE_COUNT]; /**< stores all edges of the solution set. */
 } arcset;
 
+/**
+ * @brief Defines new type for a graph update as struct.
+ * @details A graph update either inserts or deletes the edge "e". Applying the update with
+ * number n to the graph of epoch n results in the graph of epoch n + 1.
+ */
+typedef struct
+{
+    int insert; /**< 1 if the edge is inserted, 0 if it is deleted */
+    edge e;     /**< the edge to insert or delete */
+} graph_update;
+
+/**
+ * @brief Defines new type for an elite ordering as struct.
+ * @details An elite is a vertex ordering which produced one of the best arcsets found so far
+ * by any generator. "size" holds the size of the arcset the ordering produced, "nodes" the
+ * number of nodes of the ordering. "epoch" tells for which graph epoch the size is valid.
+ * The ordering itself is stored in the elite_perms area at the end of the shared memory.
+ */
+typedef struct
+{
+    int size;           /**< size of the arcset the ordering produced */
+    unsigned int epoch; /**< graph epoch the size was computed for */
+    unsigned int nodes; /**< number of nodes of the ordering */
+} elite;
+
 /**
  * @brief struct which represents the shared memory.
  * 
@@ -112,17 +149,70 @@ typedef struct
  * Last but not least the memory stores an arcset array, which is the actual
  * circularBuffer. It has a length of BUFFER_SIZE and is written by the generator processes and
  * read by the supervisor process.
+ * Besides the buffer the memory holds the elite pool, a small set of the best orderings
+ * which generators publish and pull from to seed their own search, and the graph update log.
+ * The supervisor appends each edge insert or delete to the log and increments the epoch, so
+ * generators can replay all updates since the epoch they know. Generators which fall more than
+ * UPDATE_LOG_SIZE updates behind read the graph snapshot (see struct graph_snapshot) instead.
+ * The orderings of the elite pool follow the struct in "elite_perms", one after another with a
+ * stride of "node_cap" ints. The supervisor sizes the shared memory for its number of nodes.
  */
 struct graph_shm
 {
     int wr_pos;               /**< holds current write position of the circular buffer */
     unsigned int status;      /**< represents the status of the circular buffer (0 is ok, 1 is success quit)*/
     arcset sets[BUFFER_SIZE]; /**< stores the arcset which are determine by the generators */
-} * shm;
+    unsigned int elite_count; /**< number of valid entries in the elite pool */
+    elite elites[ELITE_SIZE]; /**< stores the best orderings published by the generators */
+    pid_t worker_pids[MAX_WORKERS]; /**< pid of the generator holding each worker index, 0 if the index is free */
+    unsigned int worker_count; /**< number of generators announced by the supervisor, 0 if unknown */
+    unsigned long seed;       /**< base seed all worker seed streams are derived from */
+    unsigned int elite_off;   /**< 1 if the elite pool is turned off, so runs with the same seed can be repeated */
+    unsigned int epoch;       /**< current graph epoch, number of updates published so far */
+    graph_update updates[UPDATE_LOG_SIZE]; /**< update n is stored at index n % UPDATE_LOG_SIZE */
+    unsigned int node_cap;    /**< maximum number of nodes of an ordering in the elite pool */
+    int elite_perms[];        /**< ELITE_SIZE orderings of node_cap ints each */
+};
+
+/**
+ * @brief struct which represents the graph snapshot.
+ * 
+ * @details The snapshot is a shared memory object of its own, since it grows with the graph.
+ * It always holds the graph of the current epoch of graph_shm, so a generator can join a job
+ * at any time instead of replaying the whole update log. It is written by the supervisor only,
+ * both reading and writing happen while GRAPH_SEM is held.
+ */
+struct graph_snapshot
+{
+    size_t len;    /**< number of edges */
+    size_t nodes;  /**< number of nodes */
+    edge edges[];  /**< the edges of the graph */
+};
+
+extern struct graph_shm *shm; /**< stores the mapped shared memory */
+extern sem_t *used_sem;       /**< stores the used semaphore */
+extern sem_t *free_sem;       /**< stores the free semaphore */
+extern sem_t *mutex_sem;      /**< stores the mutex semphore*/
+extern sem_t *elite_sem;      /**< stores the elite semaphore */
+extern sem_t *graph_sem;      /**< stores the graph semaphore */
+
+#ifdef CB_STATS
+/**
+ * @brief Counts how long write_set() was blocked in its semaphores.
+ * @details Only compiled in with -DCB_STATS (used by cbbench.c). A wait counts as blocked if
+ * sem_trywait() failed, only then the time until sem_wait() returns is measured.
+ * The values are per process.
+ */
+typedef struct
+{
+    double free_wait;           /**< seconds blocked in FREE_SEM */
+    double mutex_wait;          /**< seconds blocked in MUTEX_SEM */
+    unsigned long free_blocks;  /**< number of times FREE_SEM blocked */
+    unsigned long mutex_blocks; /**< number of times MUTEX_SEM blocked */
+} cb_stats;
 
-sem_t *used_sem;  /**< stores the used semaphore */
-sem_t *free_sem;  /**< stores the free semaphore */
-sem_t *mutex_sem; /**< stores the mutex semphore*/
+extern cb_stats sem_stats; /**< semaphore statistics of this process */
+#endif
 
 /***************************
  *  SEM AND SHM FUNCTIONS  *
@@ -131,9 +221,12 @@ sem_t *mutex_sem; /**< stores the mutex semphore*/
  * @brief Manages the smooth cleaning of semaphores and shm
  * 
  * @details It is repsonsible to unmap the shared memory via munmap(), closes all
- * semaphores via sem_close() and unlinks them via sem_unlink if the program is the supervisor.c programm.
+ * semaphores via sem_close() and unlinks them via sem_unlink if the program is the supervisor.c programm
+ * and setup_supervisor() was called already. So a supervisor which fails on its arguments leaves the
+ * shm, semaphores and fifo of a running job alone.
  * It prints also error messages if one the functions doesnt work as expected. 
  * If no one of the globalvariables ***_set is set to true, the function will not try to close these semaphores.
+ * A generator releases its worker index first, so another generator can take it over.
  * 
  * @see err_msg()
  * 
@@ -153,23 +246,47 @@ void clean_up(char *progn);
  * USED_SEM is initialized with 0 since the supervisor should only read when there is something to read.
  * FREE_SEM is initialized with BUFFER_SIZE from above since at the beginning nothin is written to the Buffer.
  * MUTEX_SEM is initialized with 1 since the first generator who writes need to decrement and after writing increment it.
+ * ELITE_SEM is initialized with 1 since it guards the elite pool the same way MUTEX_SEM guards the buffer.
+ * GRAPH_SEM is initialized with 1 as well and guards the graph update log.
+ * At last the CONTROL_FIFO is created, over which graph updates are passed to the supervisor.
+ * An existing path is only used if it is a fifo owned by the user with no permissions for others,
+ * since anyone can create it in /tmp ahead of time.
+ * 
+ * The shared memory is sized for ELITE_SIZE orderings of node_cap nodes. It is cleared, so nothing
+ * of a previous run is left, and the announced number of workers, the base seed and whether the
+ * elite pool is turned off are stored for the generators.
  * 
  * When a semaphore is opened, the global variable ****_set are set to true.
+ * 
+ * @param workers number of generators which will take part, 0 if unknown.
+ * @param seed base seed the generators derive their seed streams from.
+ * @param elite_off 1 to turn off the elite pool, 0 otherwise.
+ * @param node_cap maximum number of nodes of the graph, sizes the elite pool.
  */
-void setup_supervisor(void);
+void setup_supervisor(unsigned int workers, unsigned long seed, unsigned int elite_off, size_t node_cap);
 
 /**
  * @brief Manages the setup of the generate process.
  * 
  * @details Since generate.c is the client, it just need to link to the shared memoy and semaphores without creating it.
  * If there was no semaphore or shm created, this function exits in an error.
+ * The size of the shm is taken from the shm object, since the supervisor chooses it.
  * 
  * The function opens following semaphores and shm:
- * USED_SEM, FREE_SEM, MUTEX_SEM and SHM_NAME-shm.
+ * USED_SEM, FREE_SEM, MUTEX_SEM, ELITE_SEM, GRAPH_SEM and SHM_NAME-shm.
+ * 
+ * Afterwards the generator registers itself as worker: while holding MUTEX_SEM it takes the
+ * lowest free worker index and stores its pid there. An index is free if it was released by
+ * clean_up() or its generator does not exist anymore, so a crashed or restarted generator's seed
+ * stream is taken over by the next one. Only the announced number of workers, or MAX_WORKERS if
+ * unknown, are available. If all of them are taken, this function exits in an error.
  * 
  * When a semaphore is opened, the global variable ****_set are set to true.
+ * 
+ * @param index location where the worker index of the generator is stored.
+ * @param count location where the announced number of workers is stored, 0 if unknown.
  */
-void setup_generator(void);
+void setup_generator(unsigned int *index, unsigned int *count);
 
 /**
  * @brief Prints all semaphores and their values
@@ -237,6 +354,120 @@ int set_status(int status);
  */
 unsigned int get_status(void);
 
+/**
+ * @brief Publishes an ordering to the elite pool.
+ * 
+ * @details Decrements ELITE_SEM (may be blocked). If the pool is not full yet the ordering
+ * is appended, otherwise it replaces the worst entry of the pool, but only if it produced a
+ * strictly smaller arcset. Entries of an other epoch than the given one count as worse than
+ * any entry of the given epoch. An ordering which is already stored in the pool is not added twice.
+ * Orderings with more than node_cap nodes are never stored, and nothing is stored if the supervisor
+ * turned off the elite pool.
+ * 
+ * @param perm the ordering to publish.
+ * @param nodes number of nodes of the ordering.
+ * @param size size of the arcset the ordering produced.
+ * @param epoch graph epoch the size was computed for.
+ * @return 1 if the ordering was stored, 0 if not and -1 if interrupted by a signal.
+ */
+int publish_elite(const int *perm, size_t nodes, int size, unsigned int epoch);
+
+/**
+ * @brief Copies an ordering from the elite pool.
+ * 
+ * @details Decrements ELITE_SEM (may be blocked) and copies the entry at position
+ * idx modulo the number of stored entries to perm. Entries with a different number of
+ * nodes than requested are not copied, and nothing is copied if the elite pool is turned off.
+ * 
+ * @param perm location where the ordering should be stored. Must hold nodes ints.
+ * @param nodes number of nodes of the caller's graph.
+ * @param idx index of the entry to pull, taken modulo the size of the pool.
+ * @return the arcset size of the copied entry or -1 if nothing was copied.
+ */
+int pull_elite(int *perm, size_t nodes, unsigned int idx);
+
+/**
+ * @brief Locks the graph update log and snapshot.
+ * 
+ * @details Decrements GRAPH_SEM (may be blocked). Is used by the supervisor around changing its
+ * graph, write_snapshot() and publish_update(), so the three always stay consistent.
+ * 
+ * @return 0 if done, -1 if interrupted by a signal.
+ */
+int lock_graph(void);
+
+/**
+ * @brief Unlocks the graph update log and snapshot by incrementing GRAPH_SEM.
+ */
+void unlock_graph(void);
+
+/**
+ * @brief Replaces the graph snapshot.
+ * 
+ * @details Creates the SNAPSHOT_NAME shm on the first call. If the graph does not fit into the
+ * snapshot, the shm is grown to twice the needed size and mapped again. Then the graph is copied.
+ * Is only used by the supervisor, the graph must be locked via lock_graph() once generators run.
+ * 
+ * @param edges the edges of the graph.
+ * @param len number of edges.
+ * @param nodes number of nodes.
+ */
+void write_snapshot(const edge *edges, size_t len, size_t nodes);
+
+/**
+ * @brief Copies the graph snapshot.
+ * 
+ * @details Locks the graph, maps the SNAPSHOT_NAME shm with the size of the shm object, copies
+ * the graph into a newly allocated edge array and reads the epoch it belongs to.
+ * 
+ * @param edges location where the allocated edge array is stored. Must be freed by the caller.
+ * @param len location where the number of edges is stored.
+ * @param nodes location where the number of nodes is stored.
+ * @return the epoch of the snapshot or -1 if interrupted by a signal.
+ */
+int read_snapshot(edge **edges, size_t *len, size_t *nodes);
+
+/**
+ * @brief Appends a graph update to the update log.
+ * 
+ * @details Stores the update at the current epoch modulo UPDATE_LOG_SIZE and increments
+ * the epoch. Is only used by the supervisor, the graph must be locked via lock_graph().
+ * 
+ * @param upd the update to publish.
+ * @return the new epoch.
+ */
+int publish_update(graph_update upd);
+
+/**
+ * @brief Reads an update from the update log.
+ * 
+ * @details Decrements GRAPH_SEM (may be blocked) and copies the update which turns the graph
+ * of the given epoch into the graph of the next epoch.
+ * 
+ * @param epoch epoch the caller's graph is at.
+ * @param upd location where the update should be stored.
+ * @return 0 if done, 1 if the update was already overwritten in the log and -1 if there
+ * is no such update yet or the process was interrupted by a signal.
+ */
+int read_update(unsigned int epoch, graph_update *upd);
+
+/**
+ * @brief Reads the base seed from shared memory.
+ * 
+ * @returns the base seed set by the supervisor.
+ */
+unsigned long get_seed(void);
+
+/**
+ * @brief Reads the current graph epoch from shared memory.
+ * 
+ * @details Like get_status() the value is read without locking, it is only used to
+ * decide if read_update() has to be called.
+ * 
+ * @returns the current graph epoch.
+ */
+unsigned int get_epoch(void);
+
 /**
  * @brief Prints the solution of an argset. 
  * 
@@ -7,9 +7,12 @@
  * @section File Overview
  * generator is responsible for generating feedback arc sets by creating random permutations of 
  * all nodes. After generating it, the arc set is written to shared memory via write_set() by circularBuffer.c
+ * Between two iterations it replays graph updates published by the supervisor and rescores its
+ * best ordering for the new graph.
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <semaphore.h>
@@ -18,10 +21,89 @@
 #include <signal.h>
 
 #include "circularBuffer.h"
+#include "graph.h"
 
 static const char *gen_name = "generator.c"; /**< global name of the program file (set for erro messages). */
 extern volatile sig_atomic_t quit;           /**< is set extern(in circularBuffer.c) and indicates if process should end. */
 
+#define SEED_STREAM_GAP (0x9E3779B97F4A7C15ULL) /**< distance between the seeds of two neighbouring workers (golden ratio) */
+
+static unsigned long long rng_state; /**< state of the worker's random number generator, set by seed_rand() */
+
+#define ELITE_PULL_INTERVAL (16) /**< every ELITE_PULL_INTERVAL-th ordering is derived from the elite pool */
+#define PERTURB_SWAPS (4)         /**< maximum number of random swaps applied to a pulled elite ordering */
+
+/**
+ * @brief Holds all buffers needed to build and evaluate an ordering.
+ * @details The buffers are allocated once in main() and reused for every generated
+ * ordering, so the search loop itself does not allocate.
+ */
+typedef struct
+{
+    size_t nodes; /**< number of nodes of the graph (max_node + 1) */
+    int *perm;    /**< current ordering of the nodes */
+    int *pos;     /**< position of each node in perm */
+    int *mate;    /**< second elite ordering used for crossover */
+    bool *taken;  /**< marks nodes already placed during crossover */
+    const labeling *labels; /**< maps the nodes back to the original ids used in the shm */
+} ordering;
+
+/**
+ * @brief Holds the best ordering the generator found so far.
+ * @details The position index is kept next to the ordering so the arcset can be
+ * rescored edge by edge when the graph changes.
+ */
+typedef struct
+{
+    int *perm;  /**< ordering which produced set */
+    int *pos;   /**< position of each node in perm */
+    arcset set; /**< best arcset, size is __INT16_MAX__ if there is none */
+} incumbent;
+
+/**
+ * @brief Mixes a 64 bit value (splitmix64 finalizer).
+ * 
+ * @param x value to mix.
+ * @return the mixed value.
+ */
+static unsigned long long mix(unsigned long long x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Seeds the random number generator of a worker.
+ * 
+ * @details Each worker index gets its own seed stream: the base seed is moved by
+ * SEED_STREAM_GAP per index and mixed, so neighbouring workers start at unrelated states.
+ * The same base seed and index always give the same stream, which makes runs reproducible
+ * for a given number of workers if the supervisor turned off the elite pool (-d).
+ * 
+ * @param seed base seed from the supervisor.
+ * @param index worker index of this generator.
+ */
+static void seed_rand(unsigned long seed, unsigned int index)
+{
+    rng_state = mix(seed + (index + 1) * SEED_STREAM_GAP);
+    if (rng_state == 0) /* xorshift must not start at 0 */
+        rng_state = SEED_STREAM_GAP;
+}
+
+/**
+ * @brief Returns the next random number of the worker's stream (xorshift64*).
+ * 
+ * @return a random number between 0 and UINT_MAX.
+ */
+static unsigned int next_rand(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (unsigned int)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
 /**
  * @brief Generates random permutation of node array
  * @details The function generates the permutation with the Fisher-Yates algorithm.
@@ -37,179 +119,475 @@ extern volatile sig_atomic_t quit;           /**< is set extern(in circularBuffe
  * with the old value of the current index.
  * The algorithm does it for each element from the tail of the array to the head.
  * 
- * @param max_node Is the maximum value of all nodes and implict the length of the set - 1.
- * @return It return the pointer to the first value of the set.
- * 
- * @warning Not a warning, but a inefficency issue. If for each geneartion of the permutation the old permutation would
- * be used instead of generating always the new node set, the perfomance would increase.
- * 
+ * @param perm Location where the permutation is stored. Must hold nodes ints.
+ * @param nodes Is the number of nodes (maximum node + 1 because 0 is also a node).
  */
-static int *get_perm(size_t max_node)
+static void get_perm(int *perm, size_t nodes)
 {
-    size_t tmps = max_node + 1; /* maxnode + 1 because max_node is the larges node of graph but 0 is also a node */
-    int *perm = malloc(sizeof(int) * tmps + 1);
-    for (int i = 0; i < tmps; i++)
+    for (int i = 0; i < nodes; i++)
         perm[i] = i;
 
-    for (int i = tmps - 1; i >= 0; --i) /* Fisher-Yates algorithm */
+    for (int i = nodes - 1; i >= 0; --i) /* Fisher-Yates algorithm */
+    {
+        int j = next_rand() % (i + 1);
+
+        int temp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = temp;
+    }
+}
+
+/**
+ * @brief Perturbs an ordering by a few random swaps.
+ * 
+ * @details Swaps between 1 and PERTURB_SWAPS random pairs of nodes, so the result
+ * stays close to the given ordering but explores its neighbourhood.
+ * 
+ * @param perm ordering to perturb in place.
+ * @param nodes number of nodes in the ordering.
+ */
+static void perturb_perm(int *perm, size_t nodes)
+{
+    int swaps = 1 + next_rand() % PERTURB_SWAPS;
+    for (int k = 0; k < swaps; k++)
     {
-        int j = rand() % (i + 1);
+        int i = next_rand() % nodes;
+        int j = next_rand() % nodes;
 
         int temp = perm[i];
         perm[i] = perm[j];
         perm[j] = temp;
     }
-    return perm;
+}
+
+/**
+ * @brief Combines two orderings with order crossover (OX).
+ * 
+ * @details A random segment of ord->perm is kept at its place, all remaining positions
+ * are filled with the missing nodes in the order they appear in ord->mate.
+ * 
+ * @param ord ordering buffers. The child is written to ord->perm.
+ */
+static void crossover_perm(ordering *ord)
+{
+    size_t n = ord->nodes;
+    size_t l = next_rand() % n;
+    size_t r = next_rand() % n;
+    if (l > r)
+    {
+        size_t tmp = l;
+        l = r;
+        r = tmp;
+    }
+
+    memset(ord->taken, 0, n * sizeof(bool));
+    for (size_t i = l; i <= r; i++)
+        ord->taken[ord->perm[i]] = true;
+
+    size_t k = (r + 1) % n;
+    for (size_t i = 0; i < n; i++)
+    {
+        int v = ord->mate[(r + 1 + i) % n];
+        if (ord->taken[v])
+            continue;
+        ord->perm[k] = v;
+        k = (k + 1) % n;
+    }
+}
+
+/**
+ * @brief Pulls an ordering from the elite pool and relabels it.
+ * 
+ * @details The elite pool stores orderings with original node ids, so after pull_elite()
+ * every node is mapped to its relabeled id.
+ * 
+ * @param perm location where the ordering should be stored.
+ * @param ord ordering buffers, used for the number of nodes and the labeling.
+ * @return the arcset size of the pulled entry or -1 if nothing was pulled.
+ */
+static int pull_ordering(int *perm, const ordering *ord)
+{
+    int size = pull_elite(perm, ord->nodes, next_rand());
+    if (size >= 0 && ord->labels->to_new != NULL)
+        for (size_t i = 0; i < ord->nodes; i++)
+            perm[i] = new_label(ord->labels, perm[i]);
+    return size;
+}
+
+/**
+ * @brief Publishes an ordering with original node ids to the elite pool.
+ * 
+ * @details If the graph was relabeled the ordering is mapped back to the original ids in
+ * ord->mate first, which is only used inside next_perm() and therefore free here.
+ * 
+ * @param ord ordering buffers.
+ * @param perm the ordering to publish.
+ * @param size size of the arcset the ordering produced.
+ * @param epoch graph epoch the size was computed for.
+ */
+static void publish_ordering(ordering *ord, const int *perm, int size, unsigned int epoch)
+{
+    if (ord->labels->to_orig == NULL)
+    {
+        publish_elite(perm, ord->nodes, size, epoch);
+        return;
+    }
+
+    for (size_t i = 0; i < ord->nodes; i++)
+        ord->mate[i] = orig_label(ord->labels, perm[i]);
+    publish_elite(ord->mate, ord->nodes, size, epoch);
+}
+
+/**
+ * @brief Writes an arcset with original node ids to the circular buffer.
+ * 
+ * @param set the arcset with relabeled node ids.
+ * @param l the labeling of the graph.
+ */
+static void write_orig(arcset set, const labeling *l)
+{
+    for (int i = 0; i < set.size; i++)
+    {
+        set.edges[i].a = orig_label(l, set.edges[i].a);
+        set.edges[i].b = orig_label(l, set.edges[i].b);
+    }
+    write_set(set);
+}
+
+/**
+ * @brief Builds the next ordering to evaluate.
+ * 
+ * @details Usually a fresh ordering is generated by get_perm(). Every ELITE_PULL_INTERVAL-th
+ * call an ordering is pulled from the elite pool instead. If a second elite can be pulled too
+ * both are combined by crossover_perm(), otherwise the pulled one is changed by perturb_perm().
+ * If the pool is empty the function falls back to get_perm().
+ * 
+ * @param ord ordering buffers. The result is written to ord->perm.
+ * @param iter number of the current iteration.
+ */
+static void next_perm(ordering *ord, unsigned long iter)
+{
+    if (iter % ELITE_PULL_INTERVAL == 0 && pull_ordering(ord->perm, ord) >= 0)
+    {
+        if (next_rand() % 2 == 0 && pull_ordering(ord->mate, ord) >= 0)
+            crossover_perm(ord);
+        else
+            perturb_perm(ord->perm, ord->nodes);
+        return;
+    }
+
+    get_perm(ord->perm, ord->nodes);
 }
 
 /**
  * @brief Generates a new feedback arc set.
  * 
- * @details The function generates an arc set by getting a random permutation of
- * nodes from get_perm() and comparing it with the edges of the given graph.
+ * @details The function generates an arc set by getting the next ordering of
+ * nodes from next_perm() and comparing it with the edges of the given graph.
  * 
- * It runs through all edges of the graph. For each edge it runs throug
- * the whole permutation of nodes and searches for wether node a or b of the edge.
- * When it found on node it can stop because:
- *      - if the node is the first node this edge is not in the arc set. (because the second is "greater" than the first)
- *      - if the node is the second node this edge is in the arc set for sure. (because the first is "greater than the second")
+ * First the position index of the ordering is built, so the position of every node
+ * can be looked up directly. Then it runs through all edges of the graph:
+ *      - if node a comes before node b this edge is not in the arc set.
+ *      - if node b comes before node a this edge is in the arc set for sure.
  * If the edge should be in the arc set, it is added to the index of add_i and increments add_i by 1.
  * It takes the next edge and does the same process again.
  * 
  * At the end we got an array of edges in our arc set. add_i is added else size of the arc set and
  * 0 is returned.
  * 
- * If the add_i index reaches 7 so there are would be more than 8 edges, the function returns -1, so
+ * If the arc set would have more than EDGE_COUNT edges, the function returns -1, so
  * the generator know that this arcset should not be written to shared memory.
  * 
- * @see get_perm()
+ * @see next_perm()
  * 
  * @param set Is a pointer to the arc set where the generated arc set should be stored
  * @param len Is the length of the given graph (number of edges)
  * @param graph Is a pointer to the graph the function is operating with
- * @param max_node is the maximum value of all nodes an implicit indicates the length of the nodes array
+ * @param ord Is the ordering buffers. After the call ord->perm holds the evaluated ordering.
+ * @param iter Is the number of the current iteration, passed to next_perm()
  * 
  * @return Return 0 if successfully stored arcset at pointer location and -1 if the arcset
- * would have more than 8 edges.
+ * would have more than EDGE_COUNT edges.
  * 
  * 
 */
-static int gen_set(arcset *set, size_t len, edge *graph, size_t max_node)
+static int gen_set(arcset *set, size_t len, edge *graph, ordering *ord, unsigned long iter)
 {
-    int *perm = get_perm(max_node);
+    next_perm(ord, iter);
+
+    for (size_t j = 0; j < ord->nodes; j++)
+        ord->pos[ord->perm[j]] = j;
 
     size_t add_i = 0;
     for (size_t i = 0; i < len; i++)
     {
-        if (add_i >= EDGE_COUNT) /* store max of 8 edges... max index 7 */
-            return -1;
-
-        size_t a = (graph + i)->a;
-        size_t b = (graph + i)->b;
-
-        bool add = false;
-        for (size_t j = 0; j < max_node + 1; j++)
+        if (ord->pos[graph[i].b] < ord->pos[graph[i].a])
         {
-            if (perm[j] == a)
-                break;
-            if (perm[j] == b)
-            {
-                add = true;
-                break;
-            }
-        }
+            if (add_i >= EDGE_COUNT) /* store max of EDGE_COUNT edges */
+                return -1;
 
-        if (add)
-        {
             set->edges[add_i] = graph[i];
             add_i++;
         }
     }
 
-    free(perm);
-
     set->size = add_i;
 
     return 0;
 }
 
 /**
- * @brief Generates graph from given program arguments
+ * @brief Resizes all node sized buffers.
  * 
- * @details The arguments of the generator progam looks like "generator 1-2 2-3 3-1" where
- * each "*-*" indicates an edge of the graph. The * are the values of this edge.
- * The function runs through alle strings of the given argument values and 
- * parse them to and edge type. This is done by using sscanf() where the
- * format of the string can be set. sscanf() does not have an error code when the format
- * does match with the string, but it returns the number of found parameter.
+ * @details Is called when an inserted edge introduces nodes larger than the current maximum node.
+ * The new nodes are appended at the end of the best ordering, so the ordering stays valid and
+ * all existing edges keep their direction.
  * 
- * If this number is not 2 (because 1 edge has 2 nodes) the inbut is not valid -> an
- * error exit is executing
+ * @param ord ordering buffers to resize.
+ * @param best best ordering to resize and extend.
+ * @param nodes new number of nodes.
+ */
+static void resize_nodes(ordering *ord, incumbent *best, size_t nodes)
+{
+    ord->perm = realloc(ord->perm, nodes * sizeof(int));
+    ord->pos = realloc(ord->pos, nodes * sizeof(int));
+    ord->mate = realloc(ord->mate, nodes * sizeof(int));
+    ord->taken = realloc(ord->taken, nodes * sizeof(bool));
+    best->perm = realloc(best->perm, nodes * sizeof(int));
+    best->pos = realloc(best->pos, nodes * sizeof(int));
+    if (ord->perm == NULL || ord->pos == NULL || ord->mate == NULL || ord->taken == NULL || best->perm == NULL || best->pos == NULL)
+        error_exit((char *)gen_name, __LINE__, "Could not resize ordering", 1);
+
+    for (size_t v = ord->nodes; v < nodes; v++)
+    {
+        best->perm[v] = v;
+        best->pos[v] = v;
+    }
+    ord->nodes = nodes;
+}
+
+/**
+ * @brief Applies one graph update and rescores the best arcset.
  * 
- * If not, the edge is stored in the graph at its index i.
- * The variable mn represents the maximum node. If one of the new obtained nodes 
- * is greater than the old maximum node, the node updates. 
+ * @details The edge array is updated via update_graph(). Instead of evaluating the best
+ * ordering from scratch only the changed edge is looked at:
+ *      - a deleted backward edge is removed from the best arcset.
+ *      - an inserted backward edge is added to the best arcset. If the arcset would have more
+ *        than EDGE_COUNT edges the best arcset is dropped.
  * 
- * @param graph pointer to the location where the graph should be stored
- * @param len pointer to length of the argument value array
- * @param argv pointer to string array with all positional arguments
+ * @param upd the update to apply.
+ * @param g the graph to update.
+ * @param ord ordering buffers, resized if the update introduces new nodes.
+ * @param best best ordering and arcset to rescore.
+ */
+static void apply_update(const graph_update *upd, graph_t *g, ordering *ord, incumbent *best)
+{
+    edge e = upd->e;
+
+    if (update_graph(g, upd) == 0)
+        return;
+
+    size_t mn = e.a > e.b ? e.a : e.b;
+    if (mn + 1 > ord->nodes)
+        resize_nodes(ord, best, mn + 1);
+
+    if (best->set.size > EDGE_COUNT || best->pos[e.b] >= best->pos[e.a])
+        return;
+
+    if (upd->insert)
+    {
+        if (best->set.size < EDGE_COUNT)
+            best->set.edges[best->set.size++] = e;
+        else
+            best->set.size = __INT16_MAX__;
+        return;
+    }
+
+    for (int k = 0; k < best->set.size; k++)
+    {
+        if (best->set.edges[k].a == e.a && best->set.edges[k].b == e.b)
+        {
+            best->set.edges[k] = best->set.edges[--best->set.size];
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Replaces the graph by the current graph of the supervisor.
  * 
- * @return Returns a positiv long which represents the maximum node found in the graph.
+ * @details Reads the graph snapshot via read_snapshot() and takes over its edges and epoch.
  * 
-*/
-static size_t create_graph(edge *graph, size_t *len, char const *argv[])
+ * @param g the graph to replace.
+ * @return the number of nodes of the new graph.
+ */
+static size_t load_snapshot(graph_t *g)
 {
-    int v1 = 0;
-    int v2 = 0;
-    size_t mn = 0;
+    size_t len;
+    size_t nodes;
+    edge *edges;
+    int epoch = read_snapshot(&edges, &len, &nodes);
+    if (epoch == -1)
+        error_exit((char *)gen_name, __LINE__, "Interrupted while reading graph snapshot", 0);
 
-    for (size_t i = 1; i < *len + 1; i++)
+    free(g->edges);
+    g->edges = edges;
+    g->len = len;
+    g->cap = len; /* read_snapshot() allocated len edges, update_graph() grows the array from there */
+    g->epoch = epoch;
+    return nodes;
+}
+
+/**
+ * @brief Brings the graph to the current epoch of the supervisor.
+ * 
+ * @details Reads every update between the epoch of the graph and the current epoch via
+ * read_update() and applies it with apply_update(). Afterwards the rescored best arcset is
+ * written to the circular buffer and its ordering published to the elite pool, so the search
+ * continues from the best ordering instead of starting cold.
+ * 
+ * Updates use original node ids and are relabeled before they are applied. A relabeled graph is
+ * sorted again via sort_edges() afterwards, since update_graph() does not keep the edges sorted.
+ * If updates were already overwritten in the update log, the graph is replaced by the current
+ * one via load_snapshot() instead, relabeled again if the generator relabels and the search
+ * starts over from a random ordering.
+ * 
+ * @param g the graph to update.
+ * @param ord ordering buffers.
+ * @param best best ordering and arcset to rescore.
+ * @param labels the labeling of the graph, rebuilt if the graph is replaced.
+ */
+static void sync_graph(graph_t *g, ordering *ord, incumbent *best, labeling *labels)
+{
+    graph_update upd;
+    while (g->epoch != get_epoch())
     {
-        int readitems = sscanf(argv[i], "%d-%d", &v1, &v2);
-        if (readitems != 2 || v1 < 0 || v2 < 0)
-            error_exit((char *)gen_name, __LINE__ - 2, "Input is not a graph!", 0);
-        edge e = {.a = v1,
-                  .b = v2};
+        int ret = read_update(g->epoch, &upd);
+        if (ret == -1)
+            return;
+        if (ret == 1) /* update log wrapped */
+        {
+            size_t nodes = load_snapshot(g);
+            if (labels->to_new != NULL)
+            {
+                free_labeling(labels);
+                relabel_graph(g, nodes, labels);
+            }
+            if (nodes > ord->nodes)
+                resize_nodes(ord, best, nodes);
 
-        mn = v1 > mn ? (size_t)v1 : mn;
-        mn = v2 > mn ? (size_t)v2 : mn;
+            get_perm(best->perm, ord->nodes);
+            for (size_t v = 0; v < ord->nodes; v++)
+                best->pos[best->perm[v]] = v;
+            best->set.size = __INT16_MAX__;
+            continue;
+        }
 
-        graph[i - 1] = e;
+        upd.e.a = new_label(labels, upd.e.a);
+        upd.e.b = new_label(labels, upd.e.b);
+        apply_update(&upd, g, ord, best);
+        g->epoch++;
     }
 
-    return mn;
+    if (labels->to_new != NULL) /* update_graph() does not keep the order relabel_graph() made */
+        sort_edges(g);
+
+    best->set.epoch = g->epoch;
+    if (best->set.size > EDGE_COUNT)
+        return;
+
+    publish_ordering(ord, best->perm, best->set.size, g->epoch);
+    write_orig(best->set, ord->labels);
 }
 
 /**
  * @brief Managing whole process of generator
  * 
- * @details First the graph is created via create_graph(). If no exception is thrown, all
- * semaphores and shm will get setted up by setup_generator.
+ * @details First the graph is created via create_graph().
+ * If no exception is thrown, all semaphores and shm will get setted up by setup_generator, which
+ * also assigns the worker index. The random number generator is seeded with the stream of this
+ * index via seed_rand(), so every generator searches different orderings. If the supervisor has
+ * published graph updates already, the graph is replaced by the current one via load_snapshot().
+ * With option -r the graph is relabeled via relabel_graph() afterwards, which sorts the edges so
+ * a scan over them reads the position index nearly sequentially. Since gen_set() builds that index
+ * from a random ordering and stops early, random orderings do not get faster by it. All arcsets and
+ * orderings leaving the generator are mapped back to the original node ids.
  * Now the while loop is entered and the status of the shm is asked. 
  * Then a new arc set is generated and written two shared memory via 
  * write_set() from circularBuffer.c. Except gen_set() return -1, than
  * this solution will ignored and the process jumps directly to the next loop sequence.
+ * Whenever an arc set is smaller than the best one this generator found so far, the
+ * ordering behind it is stored and published to the elite pool via publish_elite().
+ * Before each iteration the epoch of the shm is compared with the one of the graph, if they
+ * differ the graph is updated via sync_graph().
  * 
  * If the atomic variable quit equals 1, the loop will break an succes exit will executed.
  * 
  * @see create_graph()
  * @see gen_set()
+ * @see sync_graph()
  * 
- * @param argc If the count of arguments is less than 2 an exception is thrown.
- * @param argv Pointer to positional arguments. Must have structure [*-*] with numbers at each end of the "-".
+ * @param argc If the count of positional arguments is less than 1 an exception is thrown.
+ * @param argv Pointer to arguments. Optional -r, followed by positional arguments which must have
+ * structure [*-*] with numbers at each end of the "-".
  * 
 */
 int main(int argc, char const *argv[])
 {
 
-    if (argc < 2)
+    bool relabel = false;
+    int c;
+    while ((c = getopt(argc, (char *const *)argv, "r")) != -1)
+    {
+        if (c == 'r')
+            relabel = true;
+        else
+            error_exit((char *)gen_name, __LINE__, "Usage: generator [-r] EDGE...", 0);
+    }
+
+    if (argc - optind < 1)
         error_exit((char *)gen_name, __LINE__ - 1, "No arguments passed!", 0);
 
-    size_t len = argc - 1;
-    edge *graph = (edge *)malloc(len * sizeof(edge));
-    size_t maxNode = create_graph(graph, &len, argv);
+    graph_t g;
+    g.len = argc - optind;
+    g.cap = g.len;
+    g.epoch = 0; /* argv holds the graph of epoch 0 */
+    g.edges = (edge *)malloc(g.cap * sizeof(edge));
+    size_t maxNode = create_graph(g.edges, &g.len, argv + optind - 1);
 
-    setup_generator();
+    unsigned int worker;
+    unsigned int workers;
+    setup_generator(&worker, &workers);
+    seed_rand(get_seed(), worker);
+
+    if (get_epoch() > 0) /* the graph was changed already, start at the current one */
+        maxNode = load_snapshot(&g) - 1;
+
+    labeling labels;
+    memset(&labels, 0, sizeof(labels));
+    if (relabel)
+        relabel_graph(&g, maxNode + 1, &labels);
+
+    ordering ord;
+    ord.nodes = maxNode + 1; /* maxnode + 1 because max_node is the larges node of graph but 0 is also a node */
+    ord.perm = malloc(ord.nodes * sizeof(int));
+    ord.pos = malloc(ord.nodes * sizeof(int));
+    ord.mate = malloc(ord.nodes * sizeof(int));
+    ord.taken = malloc(ord.nodes * sizeof(bool));
+    ord.labels = &labels;
+
+    incumbent best;
+    best.perm = malloc(ord.nodes * sizeof(int));
+    best.pos = malloc(ord.nodes * sizeof(int));
+    best.set.size = __INT16_MAX__;
+    best.set.epoch = 0;
+    if (ord.perm == NULL || ord.pos == NULL || ord.mate == NULL || ord.taken == NULL || best.perm == NULL || best.pos == NULL)
+        error_exit((char *)gen_name, __LINE__, "Could not allocate ordering", 1);
+    get_perm(best.perm, ord.nodes);
+    for (size_t v = 0; v < ord.nodes; v++)
+        best.pos[best.perm[v]] = v;
+
+    unsigned long iter = 0;
 
     arcset *set = malloc(sizeof(arcset));
     while (quit != 1)
@@ -217,14 +595,33 @@ int main(int argc, char const *argv[])
         if (get_status() == 1)
             break;
 
-        if (gen_set(set, len, graph, maxNode) == -1)
+        if (get_epoch() != g.epoch)
+            sync_graph(&g, &ord, &best, &labels);
+
+        if (gen_set(set, g.len, g.edges, &ord, ++iter) == -1)
             continue;
+        set->epoch = g.epoch;
+
+        if (set->size < best.set.size)
+        {
+            best.set = *set;
+            memcpy(best.perm, ord.perm, ord.nodes * sizeof(int));
+            memcpy(best.pos, ord.pos, ord.nodes * sizeof(int));
+            publish_ordering(&ord, ord.perm, set->size, g.epoch);
+        }
 
-        write_set(*set);
+        write_orig(*set, &labels);
     }
 
-    free(graph);
+    free(g.edges);
     free(set);
+    free(ord.perm);
+    free(ord.pos);
+    free(ord.mate);
+    free(ord.taken);
+    free(best.perm);
+    free(best.pos);
+    free_labeling(&labels);
 
     printf("\nDanke und auf Wiedersehen!\n\n");
     success_exit((char *)gen_name);
@@ -0,0 +1,315 @@
+/**
+ * @project: Feedback Arc Set
+ * @module graph
+ * @author Johannes Zottele 11911133
+ * @version 1.0
+ * @date 19.11.2020
+ * @section File Overview
+ * graph contains everything both processes need to know about the graph itself: parsing it from
+ * the program arguments, applying runtime updates, relabeling it for better memory locality
+ * and checking arcsets against a compact CSR (compressed sparse row) copy of it.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "graph.h"
+
+static char *graph_name = "graph.c";
+static const size_t *rcm_degree; /**< degree of each node, used by compare_degree() during relabel_graph() */
+
+size_t create_graph(edge *graph, size_t *len, char const *argv[])
+{
+    int v1 = 0;
+    int v2 = 0;
+    size_t mn = 0;
+
+    for (size_t i = 1; i < *len + 1; i++)
+    {
+        int readitems = sscanf(argv[i], "%d-%d", &v1, &v2);
+        if (readitems != 2 || v1 < 0 || v2 < 0 || v1 == v2) /* a self-loop can never be a forward edge */
+            error_exit(graph_name, __LINE__ - 2, "Input is not a graph!", 0);
+        edge e = {.a = v1,
+                  .b = v2};
+
+        mn = v1 > mn ? (size_t)v1 : mn;
+        mn = v2 > mn ? (size_t)v2 : mn;
+
+        graph[i - 1] = e;
+    }
+
+    return mn;
+}
+
+int update_graph(graph_t *g, const graph_update *upd)
+{
+    edge e = upd->e;
+
+    size_t i = 0;
+    while (i < g->len && (g->edges[i].a != e.a || g->edges[i].b != e.b))
+        i++;
+
+    if (upd->insert)
+    {
+        if (i < g->len)
+            return 0;
+
+        if (g->len == g->cap)
+        {
+            g->cap = g->cap > 0 ? g->cap * 2 : 1;
+            g->edges = realloc(g->edges, g->cap * sizeof(edge));
+            if (g->edges == NULL)
+                error_exit(graph_name, __LINE__, "Could not resize graph", 1);
+        }
+        g->edges[g->len++] = e;
+    }
+    else
+    {
+        if (i == g->len)
+            return 0;
+
+        g->edges[i] = g->edges[--g->len];
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Compares two nodes by their degree in rcm_degree.
+ */
+static int compare_degree(const void *x, const void *y)
+{
+    size_t dx = rcm_degree[*(const unsigned int *)x];
+    size_t dy = rcm_degree[*(const unsigned int *)y];
+    return (dx > dy) - (dx < dy);
+}
+
+/**
+ * @brief Compares two edges by start node and then by end node.
+ */
+static int compare_edge(const void *x, const void *y)
+{
+    const edge *ex = x;
+    const edge *ey = y;
+    if (ex->a != ey->a)
+        return (ex->a > ey->a) - (ex->a < ey->a);
+    return (ex->b > ey->b) - (ex->b < ey->b);
+}
+
+void relabel_graph(graph_t *g, size_t nodes, labeling *l)
+{
+    csr und;
+    memset(&und, 0, sizeof(und));
+
+    edge *both = malloc(2 * g->len * sizeof(edge) + 1);
+    size_t *degree = malloc(nodes * sizeof(size_t));
+    unsigned int *start = malloc(nodes * sizeof(unsigned int));
+    bool *visited = calloc(nodes, sizeof(bool));
+    l->to_orig = malloc(nodes * sizeof(unsigned int));
+    l->to_new = malloc(nodes * sizeof(unsigned int));
+    if (both == NULL || degree == NULL || start == NULL || visited == NULL || l->to_orig == NULL || l->to_new == NULL)
+        error_exit(graph_name, __LINE__, "Could not allocate relabeling", 1);
+    l->nodes = nodes;
+
+    for (size_t i = 0; i < g->len; i++) /* undirected copy of the graph */
+    {
+        both[2 * i] = g->edges[i];
+        both[2 * i + 1].a = g->edges[i].b;
+        both[2 * i + 1].b = g->edges[i].a;
+    }
+    build_csr(&und, both, 2 * g->len, nodes);
+    free(both);
+
+    for (size_t v = 0; v < nodes; v++)
+    {
+        degree[v] = und.offset[v + 1] - und.offset[v];
+        start[v] = v;
+    }
+
+    rcm_degree = degree;
+    qsort(start, nodes, sizeof(unsigned int), compare_degree);
+    for (size_t v = 0; v < nodes; v++)
+        qsort(und.adj + und.offset[v], degree[v], sizeof(unsigned int), compare_degree);
+
+    size_t head = 0;
+    size_t tail = 0;
+    for (size_t i = 0; i < nodes; i++) /* Cuthill-McKee: bfs from lowest degree node of each component */
+    {
+        if (visited[start[i]])
+            continue;
+        visited[start[i]] = true;
+        und.queue[tail++] = start[i];
+
+        while (head < tail)
+        {
+            unsigned int v = und.queue[head++];
+            for (size_t k = und.offset[v]; k < und.offset[v + 1]; k++)
+            {
+                if (visited[und.adj[k]])
+                    continue;
+                visited[und.adj[k]] = true;
+                und.queue[tail++] = und.adj[k];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < nodes; i++) /* reverse the order */
+    {
+        l->to_orig[nodes - 1 - i] = und.queue[i];
+        l->to_new[und.queue[i]] = nodes - 1 - i;
+    }
+
+    for (size_t i = 0; i < g->len; i++)
+    {
+        g->edges[i].a = l->to_new[g->edges[i].a];
+        g->edges[i].b = l->to_new[g->edges[i].b];
+    }
+    sort_edges(g);
+
+    free_csr(&und);
+    free(degree);
+    free(start);
+    free(visited);
+}
+
+void sort_edges(graph_t *g)
+{
+    qsort(g->edges, g->len, sizeof(edge), compare_edge);
+}
+
+unsigned int orig_label(const labeling *l, unsigned int v)
+{
+    if (l->to_orig == NULL || v >= l->nodes)
+        return v;
+    return l->to_orig[v];
+}
+
+unsigned int new_label(const labeling *l, unsigned int v)
+{
+    if (l->to_new == NULL || v >= l->nodes)
+        return v;
+    return l->to_new[v];
+}
+
+void free_labeling(labeling *l)
+{
+    free(l->to_orig);
+    free(l->to_new);
+    memset(l, 0, sizeof(*l));
+}
+
+void build_csr(csr *c, const edge *edges, size_t len, size_t nodes)
+{
+    if (nodes > c->node_cap)
+    {
+        c->offset = realloc(c->offset, (nodes + 1) * sizeof(size_t));
+        c->indeg = realloc(c->indeg, nodes * sizeof(unsigned int));
+        c->queue = realloc(c->queue, nodes * sizeof(unsigned int));
+        if (c->offset == NULL || c->indeg == NULL || c->queue == NULL)
+            error_exit(graph_name, __LINE__, "Could not allocate csr graph", 1);
+        c->node_cap = nodes;
+    }
+
+    if (len > c->edge_cap)
+    {
+        c->adj = realloc(c->adj, len * sizeof(unsigned int));
+        c->removed = realloc(c->removed, len * sizeof(bool));
+        if (c->adj == NULL || c->removed == NULL)
+            error_exit(graph_name, __LINE__, "Could not allocate csr graph", 1);
+        c->edge_cap = len;
+    }
+
+    c->nodes = nodes;
+    c->len = len;
+
+    memset(c->offset, 0, (nodes + 1) * sizeof(size_t));
+    for (size_t i = 0; i < len; i++) /* count outgoing edges, shifted by one */
+        c->offset[edges[i].a + 1]++;
+    for (size_t v = 0; v < nodes; v++)
+        c->offset[v + 1] += c->offset[v];
+
+    for (size_t i = 0; i < len; i++) /* offset[a] is used as insert position and restored below */
+        c->adj[c->offset[edges[i].a]++] = edges[i].b;
+    for (size_t v = nodes; v > 0; v--)
+        c->offset[v] = c->offset[v - 1];
+    c->offset[0] = 0;
+
+    if (len > 0)
+        memset(c->removed, 0, len * sizeof(bool));
+}
+
+/**
+ * @brief Marks or unmarks one edge of the graph as removed.
+ * 
+ * @param c the CSR graph.
+ * @param e the edge to look for.
+ * @param mark true to mark an unmarked instance of the edge, false to unmark a marked one.
+ * @return true if an instance was found.
+ */
+static bool mark_edge(csr *c, edge e, bool mark)
+{
+    if (e.a >= c->nodes)
+        return false;
+
+    for (size_t k = c->offset[e.a]; k < c->offset[e.a + 1]; k++)
+    {
+        if (c->adj[k] == e.b && c->removed[k] != mark)
+        {
+            c->removed[k] = mark;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_acyclic_without(csr *c, const arcset *set)
+{
+    if (set->size < 0 || set->size > EDGE_COUNT)
+        return false;
+
+    int marked = 0;
+    while (marked < set->size && mark_edge(c, set->edges[marked], true))
+        marked++;
+
+    bool acyclic = false;
+    if (marked == set->size) /* all edges of the set are part of the graph */
+    {
+        memset(c->indeg, 0, c->nodes * sizeof(unsigned int));
+        for (size_t k = 0; k < c->len; k++)
+            if (!c->removed[k])
+                c->indeg[c->adj[k]]++;
+
+        size_t head = 0;
+        size_t tail = 0;
+        for (size_t v = 0; v < c->nodes; v++)
+            if (c->indeg[v] == 0)
+                c->queue[tail++] = v;
+
+        while (head < tail) /* Kahn's algorithm */
+        {
+            unsigned int v = c->queue[head++];
+            for (size_t k = c->offset[v]; k < c->offset[v + 1]; k++)
+                if (!c->removed[k] && --c->indeg[c->adj[k]] == 0)
+                    c->queue[tail++] = c->adj[k];
+        }
+
+        acyclic = tail == c->nodes;
+    }
+
+    for (int i = 0; i < marked; i++)
+        mark_edge(c, set->edges[i], false);
+
+    return acyclic;
+}
+
+void free_csr(csr *c)
+{
+    free(c->offset);
+    free(c->adj);
+    free(c->removed);
+    free(c->indeg);
+    free(c->queue);
+    memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,190 @@
+/**
+ * @project: Feedback Arc Set
+ * @module graph
+ * @author Johannes Zottele 11911133
+ * @version 1.0
+ * @date 19.11.2020
+ * @section File Overview
+ * graph contains everything both processes need to know about the graph itself: parsing it from
+ * the program arguments, applying runtime updates, relabeling it for better memory locality
+ * and checking arcsets against a compact CSR (compressed sparse row) copy of it.
+ */
+
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "circularBuffer.h"
+
+/**
+ * @brief Defines new type for a growable graph as struct.
+ * @details The edge array grows when edges are inserted at runtime, "epoch" tells
+ * which graph epoch of the supervisor the edges belong to.
+ */
+typedef struct
+{
+    edge *edges;        /**< edges of the graph */
+    size_t len;         /**< number of edges */
+    size_t cap;         /**< number of edges the edges array can hold */
+    unsigned int epoch; /**< graph epoch the edges belong to */
+} graph_t;
+
+/**
+ * @brief Defines new type for a CSR graph as struct.
+ * @details The targets of all edges are stored in "adj", grouped by their start node.
+ * The targets of node v are adj[offset[v]] to adj[offset[v + 1] - 1].
+ * Besides the graph the struct holds all scratch buffers needed by is_acyclic_without(),
+ * so the check itself never allocates. build_csr() only reallocates when the graph grows.
+ */
+typedef struct
+{
+    size_t nodes;         /**< number of nodes */
+    size_t len;           /**< number of edges */
+    size_t *offset;       /**< nodes + 1 offsets into adj */
+    unsigned int *adj;    /**< end nodes of all edges, grouped by start node */
+    bool *removed;        /**< marks edges which are skipped by is_acyclic_without() */
+    unsigned int *indeg;  /**< scratch buffer for the in-degrees */
+    unsigned int *queue;  /**< scratch buffer for the nodes without incoming edges */
+    size_t node_cap;      /**< number of nodes the node buffers can hold */
+    size_t edge_cap;      /**< number of edges the edge buffers can hold */
+} csr;
+
+/**
+ * @brief Defines new type for a node relabeling as struct.
+ * @details Maps the nodes of a relabeled graph back to the node ids of the original graph
+ * and the other way round. Nodes from "nodes" on are not relabeled, so nodes which are added
+ * by later graph updates keep their id. If "to_orig" is NULL the graph was not relabeled at all.
+ */
+typedef struct
+{
+    size_t nodes;          /**< number of relabeled nodes */
+    unsigned int *to_orig; /**< original id of each relabeled node, NULL if not relabeled */
+    unsigned int *to_new;  /**< relabeled id of each original node */
+} labeling;
+
+/**
+ * @brief Generates graph from given program arguments
+ * 
+ * @details The arguments of the generator progam looks like "generator 1-2 2-3 3-1" where
+ * each "*-*" indicates an edge of the graph. The * are the values of this edge.
+ * The function runs through alle strings of the given argument values and 
+ * parse them to and edge type. This is done by using sscanf() where the
+ * format of the string can be set. sscanf() does not have an error code when the format
+ * does match with the string, but it returns the number of found parameter.
+ * 
+ * If this number is not 2 (because 1 edge has 2 nodes) or the edge is a self-loop the inbut
+ * is not valid -> an error exit is executing
+ * 
+ * If not, the edge is stored in the graph at its index i.
+ * The variable mn represents the maximum node. If one of the new obtained nodes 
+ * is greater than the old maximum node, the node updates. 
+ * 
+ * @param graph pointer to the location where the graph should be stored
+ * @param len pointer to length of the argument value array
+ * @param argv pointer to string array with all positional arguments
+ * 
+ * @return Returns a positiv long which represents the maximum node found in the graph.
+ */
+size_t create_graph(edge *graph, size_t *len, char const *argv[]);
+
+/**
+ * @brief Applies one graph update to the edge array.
+ * 
+ * @details An inserted edge is appended, the edge array is doubled if it is full.
+ * A deleted edge is replaced by the last edge of the array, so the order of the edges decays.
+ * Inserting an edge which already exists or deleting one which does not exist changes nothing.
+ * 
+ * @param g the graph to update.
+ * @param upd the update to apply.
+ * @return 1 if the graph changed, 0 if not.
+ */
+int update_graph(graph_t *g, const graph_update *upd);
+
+/**
+ * @brief Relabels the nodes of a graph with the reverse Cuthill-McKee order.
+ * 
+ * @details The graph is treated as undirected. Starting with the node of lowest degree of
+ * every component a breadth first search is run, which visits the neighbours of each node by
+ * increasing degree. Reversing the visiting order gives the new labels, so nodes connected by
+ * an edge get close labels. Afterwards all edges are relabeled and sorted by start node via
+ * sort_edges(), so a scan over the edge array reads the position index nearly sequentially.
+ * This only pays off when a scan covers most edges of a large graph. gen_set() fills the position
+ * index from a random ordering, which scatters over all nodes whatever the labels are, and stops
+ * after EDGE_COUNT + 1 backward edges, so it gains nothing from the relabeling in practice.
+ * update_graph() does not keep the edges sorted, callers re-sort them via sort_edges().
+ * 
+ * @param g the graph to relabel in place.
+ * @param nodes number of nodes (maximum node + 1).
+ * @param l the labeling to fill. Its buffers are allocated by this function.
+ */
+void relabel_graph(graph_t *g, size_t nodes, labeling *l);
+
+/**
+ * @brief Sorts the edges of a graph by start node and then by end node.
+ * 
+ * @param g the graph to sort in place.
+ */
+void sort_edges(graph_t *g);
+
+/**
+ * @brief Maps a relabeled node back to its original id.
+ * 
+ * @param l the labeling.
+ * @param v the relabeled node.
+ * @return the original id of the node.
+ */
+unsigned int orig_label(const labeling *l, unsigned int v);
+
+/**
+ * @brief Maps an original node id to its relabeled node.
+ * 
+ * @param l the labeling.
+ * @param v the original node id.
+ * @return the relabeled node.
+ */
+unsigned int new_label(const labeling *l, unsigned int v);
+
+/**
+ * @brief Frees all buffers of a labeling.
+ * 
+ * @param l the labeling to free.
+ */
+void free_labeling(labeling *l);
+
+/**
+ * @brief Builds the CSR copy of an edge array.
+ * 
+ * @details Counts the outgoing edges of every node, sums them up to the offsets and
+ * places all end nodes in adj. Buffers of a previous build are reused.
+ * 
+ * @param c the CSR graph to (re)build. Must be zero initialized before the first call.
+ * @param edges the edges of the graph.
+ * @param len number of edges.
+ * @param nodes number of nodes (maximum node + 1).
+ */
+void build_csr(csr *c, const edge *edges, size_t len, size_t nodes);
+
+/**
+ * @brief Checks if removing an arcset makes the graph acyclic.
+ * 
+ * @details First every edge of the set is looked up in the adjacency of its start node and
+ * marked as removed. If an edge is not part of the graph the set is invalid.
+ * Then a topological sort (Kahn's algorithm) runs over all edges which are not marked. The graph
+ * is acyclic if every node was sorted. At last all marks are reset again.
+ * 
+ * @param c the CSR graph to check against.
+ * @param set the arcset to remove.
+ * @return true if all edges of the set exist and the remaining graph is acyclic.
+ */
+bool is_acyclic_without(csr *c, const arcset *set);
+
+/**
+ * @brief Frees all buffers of a CSR graph.
+ * 
+ * @param c the CSR graph to free.
+ */
+void free_csr(csr *c);
+
+#endif //GRAPH_H
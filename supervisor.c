@@ -7,7 +7,10 @@
  * @section File Overview
  * supervisor.c is responsible for the validation of new incoming arcsets
  * to determine if they are better than the previous one and if yes, is the graph of the
- * arcset asyclic? It is also the only output of new edges.
+ * arcset asyclic? For that it holds its own CSR copy of the graph and checks every new best
+ * arcset with a topological sort before accepting it. It is also the only output of new edges.
+ * Besides that it reads edge inserts and deletes from the CONTROL_FIFO and publishes them
+ * as new graph epochs to the generators.
  */
 
 #include <stdlib.h>
@@ -19,26 +22,246 @@
 #include <errno.h>
 #include <string.h>
 #include <signal.h>
+#include <pthread.h>
 
 #include "circularBuffer.h"
+#include "graph.h"
 
 static const char *sup_name = "supervisor.c"; /**< global name of the program file (set for erro messages). */
 extern volatile sig_atomic_t quit;            /**< is set extern(in circularBuffer.c) and indicates if process should end. */
+static size_t node_cap;                       /**< control commands may only use nodes below node_cap */
+static graph_t graph;                         /**< the current graph, changed by the control thread while GRAPH_SEM is held */
+static size_t nodes;                          /**< number of nodes of graph */
+
+/**
+ * @brief Parses and publishes one control command.
+ * 
+ * @details A command has the form "+ a-b" to insert the edge a-b or "- a-b" to delete it.
+ * A valid command is applied to the supervisor's graph right away, the graph snapshot is replaced
+ * and the update is published via publish_update(), all while the graph is locked. So the graph,
+ * the snapshot and the epoch always match. Invalid commands are reported and ignored, and so are
+ * inserts of existing and deletes of missing edges, since they would not change the graph.
+ * Self-loops are invalid, since no ordering can ever make them a forward edge, and so are nodes
+ * of node_cap and above, since the generators and the elite pool are not sized for them.
+ * 
+ * @param line the command line read from the CONTROL_FIFO.
+ */
+static void handle_command(const char *line)
+{
+    char op = 0;
+    int v1 = 0;
+    int v2 = 0;
+
+    int readitems = sscanf(line, " %c %d-%d", &op, &v1, &v2);
+    if (readitems == EOF)
+        return;
+    if (readitems != 3 || (op != '+' && op != '-') || v1 < 0 || v2 < 0)
+    {
+        error_msg((char *)sup_name, __LINE__, "Invalid control command (expected \"+ a-b\" or \"- a-b\")", 0);
+        return;
+    }
+    if (v1 == v2)
+    {
+        error_msg((char *)sup_name, __LINE__, "Invalid control command, self-loops are not allowed", 0);
+        return;
+    }
+    if ((size_t)v1 >= node_cap || (size_t)v2 >= node_cap)
+    {
+        error_msg((char *)sup_name, __LINE__, "Invalid control command, node is not below the node limit (-n)", 0);
+        return;
+    }
+
+    graph_update upd = {.insert = op == '+',
+                        .e = {.a = v1, .b = v2}};
+
+    if (lock_graph() == -1)
+        return;
+
+    int changed = update_graph(&graph, &upd);
+    if (changed)
+    {
+        size_t mn = v1 > v2 ? v1 : v2;
+        nodes = mn + 1 > nodes ? mn + 1 : nodes;
+        write_snapshot(graph.edges, graph.len, nodes);
+        graph.epoch = publish_update(upd);
+    }
+    unsigned int epoch = graph.epoch;
+
+    unlock_graph();
+
+    if (!changed)
+    {
+        error_msg((char *)sup_name, __LINE__, upd.insert ? "Ignored control command, edge already exists" : "Ignored control command, edge does not exist", 0);
+        return;
+    }
+    printf("[%s] Graph epoch %u: %s edge %d-%d\n", sup_name, epoch, upd.insert ? "inserted" : "deleted", v1, v2);
+}
+
+/**
+ * @brief Reads control commands from the CONTROL_FIFO.
+ * 
+ * @details Runs in its own thread. Opening the fifo blocks until a writer connects, then
+ * all lines are passed to handle_command() until the writer closes the fifo and
+ * the fifo is opened again.
+ * 
+ * @param arg unused.
+ * @return never returns unless the fifo cannot be opened.
+ */
+static void *control_loop(void *arg)
+{
+    char line[64];
+
+    while (1)
+    {
+        FILE *fifo = fopen(CONTROL_FIFO, "r");
+        if (fifo == NULL)
+        {
+            if (errno == EINTR)
+                continue;
+            error_msg((char *)sup_name, __LINE__, "Could not open control fifo", 1);
+            return NULL;
+        }
+
+        while (fgets(line, sizeof(line), fifo) != NULL)
+            handle_command(line);
+
+        fclose(fifo);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the control thread.
+ * 
+ * @details SIGINT and SIGTERM are blocked while the thread is created so it inherits the
+ * blocked mask and signals are always delivered to the main thread.
+ */
+static void start_control(void)
+{
+    sigset_t block;
+    sigset_t old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, control_loop, NULL) != 0)
+        error_exit((char *)sup_name, __LINE__, "Could not start control thread", 0);
+    pthread_detach(thread);
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/**
+ * @brief Reports the arcsets rejected for one epoch.
+ * 
+ * @details Is called when the epoch of the incoming sets changes and before exiting, so a faulty
+ * generator produces one line per epoch instead of one per set.
+ * 
+ * @param rejected pointer to the number of rejected arcsets, reset to 0.
+ * @param epoch the epoch the arcsets were rejected for.
+ */
+static void report_rejected(unsigned long *rejected, unsigned int epoch)
+{
+    if (*rejected == 0)
+        return;
+
+    fprintf(stderr, "[%s] Rejected %lu arcsets for graph epoch %u, graph is not acyclic without them\n", sup_name, *rejected, epoch);
+    *rejected = 0;
+}
 
 /**
  * @brief Runs the process of supervisor
  * 
- * @details First the semaphores and shm will set up (managed by circularBuffer.c).
+ * @details First the options are parsed: -s sets the base seed of the generators' seed streams
+ * (default 1), -w announces how many generators will take part (at most MAX_WORKERS) and -n sets
+ * the node limit, the number of nodes the graph may grow to by runtime inserts (default: nodes of
+ * the graph + NODE_MARGIN).
+ * -d turns off the elite pool, since pulling orderings other generators found makes the search
+ * depend on scheduling, so only then a run can be repeated with the same seed and workers.
+ * Then the graph is created via create_graph() and its CSR copy is built. Then the semaphores and
+ * shm will set up (managed by circularBuffer.c) and the graph is written to the graph snapshot, where
+ * generators read it from if they join after the first update.
  * In addition the best solution set is declared and the size of it is set to maximum Interger 
  * so each set is better then the initialized best arcset.
+ * Sets computed for an older graph epoch are dropped. When the first set of a new epoch
+ * arrives the best set is reset, since its size is not valid for the new graph anymore.
+ * 
+ * The control thread applies updates to the graph as they arrive, the CSR copy is only rebuilt
+ * under the graph lock when a better set for a newer epoch arrives.
+ * A set which is better than the best one is only accepted if is_acyclic_without() confirms
+ * that all its edges exist and removing them makes the graph acyclic. Invalid sets are dropped,
+ * so a faulty generator cannot end the job. The first one of an epoch is reported right away,
+ * the others are counted and reported via report_rejected().
+ * 
+ * @param argc If the count of positional arguments is less than 1 an exception is thrown.
+ * @param argv Pointer to arguments. Optional -s seed, -w workers, -n nodes and -d, followed by positional arguments
+ * which must have structure [*-*] with numbers at each end of the "-".
  */
 int main(int argc, char const *argv[])
 {
 
-    setup_supervisor(); /* setup for sems and shm */
+    unsigned long seed = 1;
+    unsigned int workers = 0;
+    unsigned int elite_off = 0;
+    size_t max_nodes = 0;
+    char *end;
+    int c;
+    while ((c = getopt(argc, (char *const *)argv, "s:w:n:d")) != -1)
+    {
+        switch (c)
+        {
+        case 's':
+            seed = strtoul(optarg, &end, 10);
+            break;
+        case 'w':
+            workers = strtoul(optarg, &end, 10);
+            break;
+        case 'n':
+            max_nodes = strtoul(optarg, &end, 10);
+            break;
+        case 'd':
+            elite_off = 1;
+            break;
+        default:
+            error_exit((char *)sup_name, __LINE__, "Usage: supervisor [-s seed] [-w workers] [-n nodes] [-d] EDGE...", 0);
+        }
+        if (c != 'd' && *end != '\0')
+            error_exit((char *)sup_name, __LINE__, "Usage: supervisor [-s seed] [-w workers] [-n nodes] [-d] EDGE...", 0);
+    }
+
+    if (argc - optind < 1)
+        error_exit((char *)sup_name, __LINE__ - 1, "No graph passed!", 0);
+
+    if (workers > MAX_WORKERS)
+        error_exit((char *)sup_name, __LINE__, "Too many workers announced (-w)", 0);
+
+    graph.len = argc - optind;
+    graph.cap = graph.len;
+    graph.epoch = 0;
+    graph.edges = (edge *)malloc(graph.cap * sizeof(edge));
+    nodes = create_graph(graph.edges, &graph.len, argv + optind - 1) + 1;
+
+    node_cap = max_nodes > 0 ? max_nodes : nodes + NODE_MARGIN;
+    if (node_cap < nodes)
+        error_exit((char *)sup_name, __LINE__, "Node limit (-n) is smaller than the graph", 0);
+
+    csr verify;
+    memset(&verify, 0, sizeof(verify));
+    build_csr(&verify, graph.edges, graph.len, nodes);
+    unsigned int verify_epoch = 0;
+
+    setup_supervisor(workers, seed, elite_off, node_cap); /* setup for sems and shm */
+    write_snapshot(graph.edges, graph.len, nodes);
+    start_control(); /* read graph updates from CONTROL_FIFO */
 
     arcset best_set;
     best_set.size = __INT16_MAX__;
+    best_set.epoch = 0;
+    unsigned long rejected = 0;
 
     arcset *set = malloc(sizeof(arcset));
     while (quit != 1)
@@ -50,8 +273,40 @@ int main(int argc, char const *argv[])
         if (set == NULL)
             error_exit((char *)sup_name, __LINE__, "set is NULL", 0);
 
+        if (set->epoch != get_epoch()) /* set was computed for an outdated graph */
+            continue;
+
+        if (set->epoch != best_set.epoch)
+        {
+            report_rejected(&rejected, best_set.epoch);
+            best_set.size = __INT16_MAX__;
+            best_set.epoch = set->epoch;
+        }
+
         if (set->size < best_set.size)
         {
+            if (verify_epoch != set->epoch)
+            {
+                if (lock_graph() == -1)
+                    continue;
+                if (graph.epoch == set->epoch) /* otherwise the graph changed again meanwhile */
+                {
+                    build_csr(&verify, graph.edges, graph.len, nodes);
+                    verify_epoch = graph.epoch;
+                }
+                unlock_graph();
+
+                if (verify_epoch != set->epoch)
+                    continue;
+            }
+
+            if (!is_acyclic_without(&verify, set))
+            {
+                if (rejected++ == 0)
+                    error_msg((char *)sup_name, __LINE__, "Rejected arcset, graph is not acyclic without it", 0);
+                continue;
+            }
+
             best_set = *set;
             print_solution(argv[0], &best_set);
         }
@@ -63,7 +318,10 @@ int main(int argc, char const *argv[])
         }
     }
 
+    report_rejected(&rejected, best_set.epoch);
     free(set);
+    free(graph.edges);
+    free_csr(&verify);
     set_status(1);                  /* set status to 1 so all generate know that process is ended */
     success_exit((char *)sup_name); /* exit with success and clean up before leaving */
 